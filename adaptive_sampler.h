@@ -0,0 +1,159 @@
+// Change-driven adaptive sampling for the long running (-adaptive) mode.
+// Each channel (temperature, humidity, ...) tracks its last change, a running
+// mean rate of change (trend) and a running variance of its value. While values
+// move by more than a dead band of a few output steps the interval halves (never
+// below the sensor's physical minimum), otherwise it grows up to the configured
+// maximum. The movement tests scale with the current interval, so a steady ramp
+// swings between the minimum and the interval at which one step of it reaches the
+// dead band; only fast changes hold the minimum.
+// Jitter of one output step is not movement: it cancels out of the trend and
+// stays inside the dead band. Samples that would print the same as the last output are
+// suppressed, except for a periodic heartbeat so dashboards do not look dead.
+// Header only, avoids libm so the compile lines stay unchanged.
+
+#ifndef ADAPTIVE_SAMPLER_H
+#define ADAPTIVE_SAMPLER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#define ADAPTIVE_MAX_CHANNELS 3
+#define ADAPTIVE_TEXT 24 // room for one printed value
+#define ADAPTIVE_HEARTBEAT 300.0 // seconds, re-emit unchanged values at least this often
+#define ADAPTIVE_SMOOTHING 0.3   // weight of the newest sample in the running trend and variance
+#define ADAPTIVE_DEADBAND 2.0    // changes below this many thresholds count as stable
+#define ADAPTIVE_SPEEDUP 0.5     // interval factor while values move
+#define ADAPTIVE_BACKOFF 1.5     // interval factor while values are stable
+
+// Physical minimum intervals in seconds
+#define DHT11_MIN_INTERVAL 1.0
+#define DHT22_MIN_INTERVAL 2.0
+
+struct adaptive_channel
+{
+    double threshold; // smallest meaningful change, normally the output precision
+    double last;      // last sampled value
+    char emitted[ADAPTIVE_TEXT]; // last printed value, as printed
+    double trend;     // running mean of the signed rate of change (units / s)
+    double mean;      // running mean of the value
+    double var;       // running variance of the value (units^2)
+};
+
+struct adaptive_sampler
+{
+    int channels;
+    int decimals; // precision the program prints with, used for dedup
+    struct adaptive_channel ch[ADAPTIVE_MAX_CHANNELS];
+    double min_interval, max_interval, interval; // seconds
+    double last_time, last_emit_time;
+    int has_sample, has_emit;
+};
+
+static inline double adaptive_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Function to sleep until an absolute CLOCK_MONOTONIC time in seconds
+static inline void adaptive_sleep_until(double when)
+{
+    struct timespec ts;
+    ts.tv_sec = (time_t)when;
+    ts.tv_nsec = (long)((when - ts.tv_sec) * 1e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+static inline void adaptive_init(struct adaptive_sampler *s, int channels, const double *thresholds, int decimals,
+                                 double min_interval, double max_interval)
+{
+    s->channels = channels > ADAPTIVE_MAX_CHANNELS ? ADAPTIVE_MAX_CHANNELS : channels;
+    s->decimals = decimals;
+    for (int i = 0; i < s->channels; i++)
+    {
+        s->ch[i].threshold = thresholds[i];
+        s->ch[i].last = 0;
+        s->ch[i].emitted[0] = '\0';
+        s->ch[i].trend = s->ch[i].mean = s->ch[i].var = 0;
+    }
+    s->min_interval = min_interval;
+    s->max_interval = max_interval < min_interval ? min_interval : max_interval;
+    s->interval = s->max_interval; // start slow, the first real change speeds it up
+    s->last_time = s->last_emit_time = 0;
+    s->has_sample = s->has_emit = 0;
+}
+
+// Function to feed a good sample and get the next interval in seconds
+static inline double adaptive_update(struct adaptive_sampler *s, const double *values, double now)
+{
+    if (!s->has_sample)
+    {
+        for (int i = 0; i < s->channels; i++)
+            s->ch[i].last = s->ch[i].mean = values[i];
+        s->last_time = now;
+        s->has_sample = 1;
+        return s->interval;
+    }
+
+    double dt = now - s->last_time;
+    if (dt <= 0)
+        dt = s->min_interval;
+
+    // A channel moves if the last step, the change the trend predicts over the current
+    // interval or the spread of its values reaches the dead band. Compared in squares.
+    int moving = 0;
+    for (int i = 0; i < s->channels; i++)
+    {
+        struct adaptive_channel *c = &s->ch[i];
+        double delta = values[i] - c->last;
+        double deviation = values[i] - c->mean;
+        c->trend += ADAPTIVE_SMOOTHING * (delta / dt - c->trend);
+        c->mean += ADAPTIVE_SMOOTHING * deviation;
+        c->var = (1 - ADAPTIVE_SMOOTHING) * (c->var + ADAPTIVE_SMOOTHING * deviation * deviation);
+        c->last = values[i];
+
+        double band = ADAPTIVE_DEADBAND * c->threshold;
+        double drift = c->trend * s->interval;
+        if (delta * delta >= band * band || drift * drift >= band * band || c->var >= band * band)
+            moving = 1;
+    }
+    s->last_time = now;
+
+    s->interval *= moving ? ADAPTIVE_SPEEDUP : ADAPTIVE_BACKOFF;
+
+    if (s->interval < s->min_interval)
+        s->interval = s->min_interval;
+    if (s->interval > s->max_interval)
+        s->interval = s->max_interval;
+    return s->interval;
+}
+
+// Function to decide whether a sample prints differently from the last output. Marks it emitted if so.
+// Compares the formatted text itself, printf rounds ties to even which no bucket arithmetic matches.
+static inline int adaptive_should_emit(struct adaptive_sampler *s, const double *values, double now)
+{
+    char text[ADAPTIVE_MAX_CHANNELS][ADAPTIVE_TEXT];
+    int changed = !s->has_emit;
+    for (int i = 0; i < s->channels; i++)
+    {
+        snprintf(text[i], sizeof(text[i]), "%.*f", s->decimals, values[i]);
+        if (strcmp(text[i], s->ch[i].emitted) != 0)
+            changed = 1;
+    }
+
+    double heartbeat = s->max_interval > ADAPTIVE_HEARTBEAT ? s->max_interval : ADAPTIVE_HEARTBEAT;
+    if (!changed && now - s->last_emit_time < heartbeat)
+        return 0;
+
+    for (int i = 0; i < s->channels; i++)
+        memcpy(s->ch[i].emitted, text[i], sizeof(text[i]));
+    s->last_emit_time = now;
+    s->has_emit = 1;
+    return 1;
+}
+
+#endif // ADAPTIVE_SAMPLER_H
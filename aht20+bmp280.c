@@ -3,7 +3,8 @@
 // Output is in line protocol format to use in influxdata telegraf.
 // https://docs.influxdata.com/influxdb/cloud/reference/syntax/line-protocol/
 // Program for Raspberry Pi board.
-// Compiling: gcc aht20+bmp280.c -o aht20+bmp280 -l wiringPi
+// Optional -shm publishes every sample into the shared-memory table (sensor_shm.h).
+// Compiling: gcc aht20+bmp280.c -o aht20+bmp280 -l wiringPi -l rt
 
 #include <stdio.h>
 #include <wiringPi.h>
@@ -12,6 +13,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
+#include "sensor_shm.h"
 
 // I2C addresses
 #define AHT20_ADDR 0x38
@@ -36,6 +38,9 @@ char sensor_type_name[8] = "unknown"; // Initialize to a default value
 int maxRetries = 7;
 int retries = 0;
 
+// Publish into shared memory as well
+int use_shm = 0;
+
 // Handlers
 int bmp280_fd, aht20_fd;
 
@@ -142,6 +147,9 @@ void readAHT20(int fd)
     {
         gethostname(hostbuffer, sizeof(hostbuffer));
         printf("Weather,host=%s,sensor_type_name=%s humidity=%.2f,temperature=%.2f\n", hostbuffer, sensor_type_name, humidity, temperature);
+        if (use_shm)
+            sensor_shm_publish_once(sensor_type_name, -1, SENSOR_SHM_OK,
+                                    SENSOR_SHM_TEMPERATURE | SENSOR_SHM_HUMIDITY, temperature, humidity, 0);
     }
     else
     {
@@ -153,6 +161,10 @@ void readAHT20(int fd)
             initAHT20(aht20_fd);
             readAHT20(aht20_fd);
         }
+        else if (use_shm)
+        {
+            sensor_shm_publish_once(sensor_type_name, -1, SENSOR_SHM_ERROR, 0, 0, 0, 0);
+        }
     }
 }
 
@@ -215,6 +227,9 @@ void readBMP280(int fd)
     {
         gethostname(hostbuffer, sizeof(hostbuffer));
         printf("Weather,host=%s,sensor_type_name=%s pressure=%d,temperature=%.1f\n", hostbuffer, sensor_type_name, pressure, temperature);
+        if (use_shm)
+            sensor_shm_publish_once(sensor_type_name, -1, SENSOR_SHM_OK,
+                                    SENSOR_SHM_TEMPERATURE | SENSOR_SHM_PRESSURE, temperature, 0, pressure);
     }
     else
     {
@@ -226,14 +241,18 @@ void readBMP280(int fd)
             initBMP280(bmp280_fd);
             readBMP280(bmp280_fd);
         }
+        else if (use_shm)
+        {
+            sensor_shm_publish_once(sensor_type_name, -1, SENSOR_SHM_ERROR, 0, 0, 0, 0);
+        }
     }
 }
 
 int main(int argc, char *argv[])
 {
-    if (argc != 3)
+    if (argc != 3 && argc != 4)
     {
-        fprintf(stderr, "Usage: %s -sensor <bmp280|aht20>\n", argv[0]);
+        fprintf(stderr, "Usage: %s -sensor <bmp280|aht20> [-shm]\n", argv[0]);
         exit(1);
     }
 
@@ -242,7 +261,7 @@ int main(int argc, char *argv[])
     // Parse the arguments
     for (int i = 1; i < argc; i++)
     {
-        if (strcmp(argv[i], "-sensor") == 0)
+        if (strcmp(argv[i], "-sensor") == 0 && i + 1 < argc)
         {
             i++;
             if (strcmp(argv[i], "bmp280") == 0)
@@ -261,6 +280,10 @@ int main(int argc, char *argv[])
                 exit(1);
             }
         }
+        else if (strcmp(argv[i], "-shm") == 0)
+        {
+            use_shm = 1;
+        }
         else
         {
             fprintf(stderr, "Invalid argument: %s\n", argv[i]);
@@ -270,7 +293,7 @@ int main(int argc, char *argv[])
 
     if (sensor_type == 0)
     {
-        fprintf(stderr, "Usage: %s -sensor <bmp280|aht20>\n", argv[0]);
+        fprintf(stderr, "Usage: %s -sensor <bmp280|aht20> [-shm]\n", argv[0]);
         exit(1);
     }
     if (wiringPiSetup() == -1)
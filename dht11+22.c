@@ -4,7 +4,10 @@
 // Output is in line protocol format to use in influxdata telegraf.
 // https://docs.influxdata.com/influxdb/cloud/reference/syntax/line-protocol/
 // Program for Raspberry Pi board.
-// Compiling: gcc dht11+22.c -o dht11+22 -l wiringPi
+// Optional -shm publishes every sample into the shared-memory table (sensor_shm.h).
+// Optional -adaptive keeps running and samples faster while values change (adaptive_sampler.h),
+// use it with telegraf inputs.execd.
+// Compiling: gcc dht11+22.c -o dht11+22 -l wiringPi -l rt
 
 #include <wiringPi.h>
 #include <stdio.h>
@@ -12,6 +15,8 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <string.h>
+#include "sensor_shm.h"
+#include "adaptive_sampler.h"
 
 #define MAXTIMINGS 85
 
@@ -20,6 +25,43 @@ char hostbuffer[256];
 char sensor_type_name[8] = "unknown"; // Initialize to a default value
 int maxRetries = 7;
 int retries = 0;
+int use_shm = 0; // Publish into shared memory as well
+struct sensor_shm_slot *shm_slot = NULL; // Kept open in adaptive mode
+
+// Adaptive mode
+int adaptive = 0;
+struct adaptive_sampler sampler;
+
+// Function to publish a reading (or a failed read) into shared memory
+void publish_dht_dat(int DHTPIN, int status, float temperature, float humidity)
+{
+    uint32_t fields = status == SENSOR_SHM_OK ? SENSOR_SHM_TEMPERATURE | SENSOR_SHM_HUMIDITY : 0;
+
+    if (shm_slot != NULL)
+        sensor_shm_publish(shm_slot, status, fields, temperature, humidity, 0);
+    else if (use_shm)
+        sensor_shm_publish_once(sensor_type_name, DHTPIN, status, fields, temperature, humidity, 0);
+}
+
+// Function to print and publish a valid reading
+void output_dht_dat(int DHTPIN, float temperature, float humidity)
+{
+    publish_dht_dat(DHTPIN, SENSOR_SHM_OK, temperature, humidity);
+
+    if (adaptive)
+    {
+        double values[2] = {temperature, humidity};
+        double now = adaptive_now();
+        adaptive_update(&sampler, values, now);
+        if (!adaptive_should_emit(&sampler, values, now))
+            return; // unchanged, deduplicated
+    }
+
+    gethostname(hostbuffer, sizeof(hostbuffer));
+    printf("Weather,host=%s,pinnum=%d,sensor_type_name=%s humidity=%.1f,temperature=%.1f\n",
+           hostbuffer, DHTPIN, sensor_type_name, humidity, temperature);
+    fflush(stdout); // telegraf execd reads line by line
+}
 
 // Function to read from the sensor (DHT11 or DHT22)
 void read_dht_dat(int DHTPIN, int sensor_type)
@@ -90,9 +132,7 @@ void read_dht_dat(int DHTPIN, int sensor_type)
         if ((sensor_type == 11 && temperature >= 0 && temperature <= 80 && humidity >= 0 && humidity <= 100) ||
             (sensor_type == 22 && temperature >= -40 && temperature <= 80 && humidity >= 0 && humidity <= 100))
         {
-            gethostname(hostbuffer, sizeof(hostbuffer));
-            printf("Weather,host=%s,pinnum=%d,sensor_type_name=%s humidity=%.1f,temperature=%.1f\n",
-                   hostbuffer, DHTPIN, sensor_type_name, humidity, temperature);
+            output_dht_dat(DHTPIN, temperature, humidity);
         }
         else
         {
@@ -103,6 +143,10 @@ void read_dht_dat(int DHTPIN, int sensor_type)
                 delay(3000);
                 read_dht_dat(DHTPIN, sensor_type);
             }
+            else
+            {
+                publish_dht_dat(DHTPIN, SENSOR_SHM_ERROR, 0, 0);
+            }
         }
     }
     else
@@ -114,28 +158,33 @@ void read_dht_dat(int DHTPIN, int sensor_type)
             delay(3000);
             read_dht_dat(DHTPIN, sensor_type); // Retry if the data is incorrect
         }
+        else
+        {
+            publish_dht_dat(DHTPIN, SENSOR_SHM_ERROR, 0, 0);
+        }
     }
 }
 
 int main(int argc, char *argv[])
 {
-    if (argc != 5)
+    if (argc < 5)
     {
-        fprintf(stderr, "Usage: %s -dhtpin <pin_number> -sensor <dht11|dht22>\n", argv[0]);
+        fprintf(stderr, "Usage: %s -dhtpin <pin_number> -sensor <dht11|dht22> [-shm] [-adaptive <max_seconds>]\n", argv[0]);
         exit(1);
     }
 
     int DHTPIN = -1;
     int sensor_type = 0; // Default to 0 (invalid)
+    double max_interval = 0;
 
     // Parse the arguments
     for (int i = 1; i < argc; i++)
     {
-        if (strcmp(argv[i], "-dhtpin") == 0)
+        if (strcmp(argv[i], "-dhtpin") == 0 && i + 1 < argc)
         {
             DHTPIN = atoi(argv[++i]);
         }
-        else if (strcmp(argv[i], "-sensor") == 0)
+        else if (strcmp(argv[i], "-sensor") == 0 && i + 1 < argc)
         {
             i++;
             if (strcmp(argv[i], "dht11") == 0)
@@ -154,6 +203,20 @@ int main(int argc, char *argv[])
                 exit(1);
             }
         }
+        else if (strcmp(argv[i], "-shm") == 0)
+        {
+            use_shm = 1;
+        }
+        else if (strcmp(argv[i], "-adaptive") == 0 && i + 1 < argc)
+        {
+            adaptive = 1;
+            max_interval = atof(argv[++i]);
+            if (max_interval <= 0)
+            {
+                fprintf(stderr, "Error: -adaptive needs a positive number of seconds\n");
+                exit(1);
+            }
+        }
         else
         {
             fprintf(stderr, "Invalid argument: %s\n", argv[i]);
@@ -163,7 +226,7 @@ int main(int argc, char *argv[])
 
     if (DHTPIN == -1 || sensor_type == 0)
     {
-        fprintf(stderr, "Usage: %s -dhtpin <pin_number> -sensor <dht11|dht22>\n", argv[0]);
+        fprintf(stderr, "Usage: %s -dhtpin <pin_number> -sensor <dht11|dht22> [-shm] [-adaptive <max_seconds>]\n", argv[0]);
         exit(1);
     }
 
@@ -172,7 +235,32 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
-    read_dht_dat(DHTPIN, sensor_type);
+    if (!adaptive)
+    {
+        read_dht_dat(DHTPIN, sensor_type);
+        return 0;
+    }
+
+    // DHT11 reports whole units, DHT22 tenths; neither may be polled faster than its minimum interval
+    double thresholds[2] = {sensor_type == 11 ? 1.0 : 0.1, sensor_type == 11 ? 1.0 : 0.1};
+    double min_interval = sensor_type == 11 ? DHT11_MIN_INTERVAL : DHT22_MIN_INTERVAL;
+    adaptive_init(&sampler, 2, thresholds, 1, min_interval, max_interval); // printed with %.1f
+
+    // Map the table once instead of on every tick
+    if (use_shm && (shm_slot = sensor_shm_open_slot(sensor_type_name, DHTPIN)) == NULL)
+    {
+        fprintf(stderr, "Warning: Cannot open shared memory %s, not publishing\n", SENSOR_SHM_NAME);
+        use_shm = 0;
+    }
+
+    // No blocking retries, a failed read is simply retried at the next tick
+    maxRetries = 0;
+    for (;;)
+    {
+        double start = adaptive_now();
+        read_dht_dat(DHTPIN, sensor_type);
+        adaptive_sleep_until(start + sampler.interval);
+    }
 
     return 0;
 }
@@ -2,13 +2,18 @@
 // Output is in line protocol format to use in influxdata telegraf.
 // https://docs.influxdata.com/influxdb/cloud/reference/syntax/line-protocol/
 // Program for Raspberry Pi board.
-// Compiling: gcc ds18b20.c -o ds18b20
+// Optional -shm publishes every sample into the shared-memory table (sensor_shm.h).
+// Optional -adaptive keeps running and samples faster while values change (adaptive_sampler.h),
+// use it with telegraf inputs.execd.
+// Compiling: gcc ds18b20.c -o ds18b20 -l rt
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <dirent.h>
+#include "sensor_shm.h"
+#include "adaptive_sampler.h"
 
 #define MAX_PATH 256
 #define MAX_RETRIES 7
@@ -16,6 +21,24 @@
 
 char hostbuffer[256];
 
+// Function to get the configured resolution (9-12 bits), 12 if the kernel does not expose it
+int read_resolution(const char *device_path)
+{
+    char path[MAX_PATH];
+    int bits = 12;
+    const char *slash = strrchr(device_path, '/');
+
+    snprintf(path, sizeof(path), "%.*sresolution", (int)(slash - device_path + 1), device_path);
+    FILE *fp = fopen(path, "r");
+    if (fp != NULL)
+    {
+        if (fscanf(fp, "%d", &bits) != 1 || bits < 9 || bits > 12)
+            bits = 12;
+        fclose(fp);
+    }
+    return bits;
+}
+
 // Function to find DS18B20 sensor by serial number or get first available
 int find_sensor(char *device_path, const char *serial)
 {
@@ -130,14 +153,18 @@ int main(int argc, char *argv[])
     float temperature;
     const char *serial = NULL;
     int pin_num = -1; // no default, must be provided via -pin
+    int use_shm = 0;  // publish into shared memory as well
+    double max_interval = 0; // -adaptive, 0 means read once
 
     // If no arguments provided, show error and help
     if (argc == 1)
     {
         fprintf(stderr, "Error: argument is required.\n");
-        fprintf(stderr, "Usage: %s -pin <gpio_pin> [-serial <28-xxxx>]\n", argv[0]);
+        fprintf(stderr, "Usage: %s -pin <gpio_pin> [-serial <28-xxxx>] [-shm] [-adaptive <max_seconds>]\n", argv[0]);
         fprintf(stderr, "  -pin: GPIO pin number (required)\n");
         fprintf(stderr, "  -serial: Specific DS18B20 serial number (optional, e.g., 28-0123456789ab)\n");
+        fprintf(stderr, "  -shm: Publish reading into shared memory %s (optional)\n", SENSOR_SHM_NAME);
+        fprintf(stderr, "  -adaptive: Keep running, sample faster while the value changes, at most every max_seconds when stable (optional)\n");
         fprintf(stderr, "\nMake sure the following modules are loaded:\n");
         fprintf(stderr, "  sudo modprobe w1-gpio\n");
         fprintf(stderr, "  sudo modprobe w1-therm\n");
@@ -156,11 +183,26 @@ int main(int argc, char *argv[])
         {
             pin_num = atoi(argv[++i]);
         }
+        else if (strcmp(argv[i], "-shm") == 0)
+        {
+            use_shm = 1;
+        }
+        else if (strcmp(argv[i], "-adaptive") == 0 && i + 1 < argc)
+        {
+            max_interval = atof(argv[++i]);
+            if (max_interval <= 0)
+            {
+                fprintf(stderr, "Error: -adaptive needs a positive number of seconds\n");
+                exit(1);
+            }
+        }
         else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
         {
-            printf("Usage: %s -pin <gpio_pin> [-serial <28-xxxx>]\n", argv[0]);
+            printf("Usage: %s -pin <gpio_pin> [-serial <28-xxxx>] [-shm] [-adaptive <max_seconds>]\n", argv[0]);
             printf("  -pin: GPIO pin number (required)\n");
             printf("  -serial: Specific DS18B20 serial number (optional, e.g., 28-0123456789ab)\n");
+            printf("  -shm: Publish reading into shared memory %s (optional)\n", SENSOR_SHM_NAME);
+            printf("  -adaptive: Keep running, sample faster while the value changes, at most every max_seconds when stable (optional)\n");
             printf("\nMake sure the following modules are loaded:\n");
             printf("  sudo modprobe w1-gpio\n");
             printf("  sudo modprobe w1-therm\n");
@@ -179,7 +221,7 @@ int main(int argc, char *argv[])
     if (pin_num < 0)
     {
         fprintf(stderr, "Error: -pin argument is required.\n");
-        fprintf(stderr, "Usage: %s -pin <gpio_pin> [-serial <28-xxxx>]\n", argv[0]);
+        fprintf(stderr, "Usage: %s -pin <gpio_pin> [-serial <28-xxxx>] [-shm] [-adaptive <max_seconds>]\n", argv[0]);
         exit(1);
     }
 
@@ -198,15 +240,63 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
+    if (max_interval > 0)
+    {
+        // Conversion takes 93.75 ms at 9 bits and doubles with every extra bit,
+        // changes below one resolution step (or the printed 0.1) are noise
+        int bits = read_resolution(device_path);
+        double step = 0.5 / (1 << (bits - 9));
+        double threshold = step > 0.1 ? step : 0.1;
+        struct adaptive_sampler sampler;
+        adaptive_init(&sampler, 1, &threshold, 1, 0.09375 * (1 << (bits - 9)), max_interval); // printed with %.1f
+
+        // Map the table once instead of on every tick
+        struct sensor_shm_slot *shm_slot = NULL;
+        if (use_shm && (shm_slot = sensor_shm_open_slot("ds18b20", pin_num)) == NULL)
+            fprintf(stderr, "Warning: Cannot open shared memory %s, not publishing\n", SENSOR_SHM_NAME);
+
+        gethostname(hostbuffer, sizeof(hostbuffer));
+        for (;;)
+        {
+            double start = adaptive_now();
+
+            // No blocking retries, a failed read is simply retried at the next tick
+            if (read_ds18b20(device_path, &temperature, MAX_RETRIES))
+            {
+                double value = temperature;
+                double now = adaptive_now();
+                if (shm_slot != NULL)
+                    sensor_shm_publish(shm_slot, SENSOR_SHM_OK, SENSOR_SHM_TEMPERATURE, temperature, 0, 0);
+                adaptive_update(&sampler, &value, now);
+                if (adaptive_should_emit(&sampler, &value, now))
+                {
+                    printf("Weather,host=%s,pinnum=%d,sensor_type_name=ds18b20 temperature=%.1f\n",
+                           hostbuffer, pin_num, temperature);
+                    fflush(stdout); // telegraf execd reads line by line
+                }
+            }
+            else if (shm_slot != NULL)
+            {
+                sensor_shm_publish(shm_slot, SENSOR_SHM_ERROR, 0, 0, 0, 0);
+            }
+
+            adaptive_sleep_until(start + sampler.interval);
+        }
+    }
+
     // Read temperature with retry logic
     if (read_ds18b20(device_path, &temperature, 0))
     {
         gethostname(hostbuffer, sizeof(hostbuffer));
         printf("Weather,host=%s,pinnum=%d,sensor_type_name=ds18b20 temperature=%.1f\n",
                hostbuffer, pin_num, temperature);
+        if (use_shm)
+            sensor_shm_publish_once("ds18b20", pin_num, SENSOR_SHM_OK, SENSOR_SHM_TEMPERATURE, temperature, 0, 0);
     }
     else
     {
+        if (use_shm)
+            sensor_shm_publish_once("ds18b20", pin_num, SENSOR_SHM_ERROR, 0, 0, 0, 0);
         fprintf(stderr, "Failed to read temperature from DS18B20\n");
         exit(1);
     }
@@ -0,0 +1,323 @@
+// Shared-memory table with the latest reading of every sensor.
+// Sensor programs publish each sample into a fixed-layout table in POSIX
+// shared memory (/dev/shm), one cache-line-aligned slot per sensor.
+// Every slot is protected by a seqlock: the owner of a sensor enters the write
+// section with a compare-and-swap (overlapping runs of the same sensor take
+// turns, a slot left half written by a killed process is taken over) and any
+// number of local readers (OLED screens, scripts, Telegraf via shm_reader) copy
+// the latest value lock-free without touching the sensor bus.
+// Header only, included by the sensor programs and shm_reader.c.
+// Compiling users need: -l rt (older glibc only)
+
+#ifndef SENSOR_SHM_H
+#define SENSOR_SHM_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sched.h>
+#include <signal.h>
+#include <errno.h>
+
+#define SENSOR_SHM_NAME "/rpi_weather_sensors"
+#define SENSOR_SHM_MAGIC 0x57535233 // "WSR3", bump when the layout changes
+#define SENSOR_SHM_SLOTS 16
+#define SENSOR_SHM_CACHE_LINE 64
+#define SENSOR_SHM_SPINS 1000 // attempts before a busy slot is given up on, the writer may be preempted
+
+// Slot states
+#define SENSOR_SHM_FREE 0
+#define SENSOR_SHM_CLAIMING 1
+#define SENSOR_SHM_USED 2
+
+// Reading status
+#define SENSOR_SHM_OK 0
+#define SENSOR_SHM_ERROR 1 // last read failed, values are from the previous good sample
+
+// Field mask bits
+#define SENSOR_SHM_TEMPERATURE 0x01
+#define SENSOR_SHM_HUMIDITY 0x02
+#define SENSOR_SHM_PRESSURE 0x04
+
+// Snapshot of one sensor, copied out of the table by readers
+struct sensor_reading
+{
+    char sensor_type_name[8]; // dht11, dht22, ds18b20, aht20, bmp280
+    int32_t pin;              // GPIO pin, -1 for I2C sensors
+    int32_t status;           // SENSOR_SHM_OK or SENSOR_SHM_ERROR
+    uint32_t fields;          // SENSOR_SHM_TEMPERATURE | ...
+    float temperature;
+    float humidity;
+    float pressure;
+    int64_t timestamp_ns;      // CLOCK_REALTIME of the last publish, good or not
+    int64_t good_timestamp_ns; // CLOCK_REALTIME of the values, use this for staleness
+};
+
+// One slot fills exactly one cache line so writers of different sensors never share a line
+struct sensor_shm_slot
+{
+    _Atomic uint32_t seq;   // odd while a writer is in the write section
+    _Atomic uint32_t state; // SENSOR_SHM_FREE, _CLAIMING or _USED
+    _Atomic int32_t writer; // pid inside the write section, 0 if none (or not yet stored)
+    struct sensor_reading reading;
+} __attribute__((aligned(SENSOR_SHM_CACHE_LINE)));
+
+struct sensor_shm_table
+{
+    _Atomic uint32_t magic;
+    uint32_t slot_count;
+    struct sensor_shm_slot slots[SENSOR_SHM_SLOTS] __attribute__((aligned(SENSOR_SHM_CACHE_LINE)));
+};
+
+_Static_assert(sizeof(struct sensor_shm_slot) == SENSOR_SHM_CACHE_LINE, "slot must fill one cache line");
+
+// Function to map the table, creating it if needed. Returns NULL on error.
+static inline struct sensor_shm_table *sensor_shm_open(int create)
+{
+    int fd = shm_open(SENSOR_SHM_NAME, create ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if (fd == -1)
+        return NULL;
+
+    if (create && ftruncate(fd, sizeof(struct sensor_shm_table)) == -1)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(struct sensor_shm_table))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void *addr = mmap(NULL, sizeof(struct sensor_shm_table), create ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                      MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return NULL;
+
+    struct sensor_shm_table *table = addr;
+    if (create)
+    {
+        // Fresh tables are zero filled, the first writer stamps the header
+        uint32_t expected = 0;
+        if (atomic_compare_exchange_strong(&table->magic, &expected, SENSOR_SHM_MAGIC))
+            table->slot_count = SENSOR_SHM_SLOTS;
+    }
+
+    if (atomic_load_explicit(&table->magic, memory_order_acquire) != SENSOR_SHM_MAGIC)
+    {
+        munmap(addr, sizeof(struct sensor_shm_table));
+        return NULL;
+    }
+
+    return table;
+}
+
+static inline void sensor_shm_close(struct sensor_shm_table *table)
+{
+    if (table != NULL)
+        munmap(table, sizeof(struct sensor_shm_table));
+}
+
+static inline int sensor_shm_slot_matches(struct sensor_shm_slot *slot, const char *sensor_type_name, int pin)
+{
+    return slot->reading.pin == pin &&
+           strncmp(slot->reading.sensor_type_name, sensor_type_name, sizeof(slot->reading.sensor_type_name)) == 0;
+}
+
+// Function to resolve two processes claiming a slot for the same sensor at the same time.
+// Both re-scan after their claim is visible; the lowest index wins and the other slot is freed.
+static inline struct sensor_shm_slot *sensor_shm_dedup_slot(struct sensor_shm_table *table, struct sensor_shm_slot *mine,
+                                                            int mine_index, const char *sensor_type_name, int pin)
+{
+    for (int i = 0; i < mine_index; i++)
+    {
+        struct sensor_shm_slot *slot = &table->slots[i];
+        uint32_t state = atomic_load_explicit(&slot->state, memory_order_acquire);
+
+        // A claim in progress is finished in nanoseconds, wait until its key is readable
+        for (int spin = 0; state == SENSOR_SHM_CLAIMING && spin < SENSOR_SHM_SPINS; spin++)
+        {
+            sched_yield();
+            state = atomic_load_explicit(&slot->state, memory_order_acquire);
+        }
+
+        if (state == SENSOR_SHM_USED && sensor_shm_slot_matches(slot, sensor_type_name, pin))
+        {
+            atomic_store_explicit(&mine->state, SENSOR_SHM_CLAIMING, memory_order_relaxed);
+            memset(&mine->reading, 0, sizeof(mine->reading));
+            atomic_store_explicit(&mine->state, SENSOR_SHM_FREE, memory_order_release);
+            return slot;
+        }
+    }
+    return mine;
+}
+
+// Function to find the slot owned by a sensor or claim a free one. Returns NULL if the table is full.
+static inline struct sensor_shm_slot *sensor_shm_slot(struct sensor_shm_table *table, const char *sensor_type_name, int pin)
+{
+    for (int i = 0; i < SENSOR_SHM_SLOTS; i++)
+    {
+        struct sensor_shm_slot *slot = &table->slots[i];
+        if (atomic_load_explicit(&slot->state, memory_order_acquire) == SENSOR_SHM_USED &&
+            sensor_shm_slot_matches(slot, sensor_type_name, pin))
+            return slot;
+    }
+
+    for (int i = 0; i < SENSOR_SHM_SLOTS; i++)
+    {
+        struct sensor_shm_slot *slot = &table->slots[i];
+        uint32_t expected = SENSOR_SHM_FREE;
+        if (atomic_compare_exchange_strong(&slot->state, &expected, SENSOR_SHM_CLAIMING))
+        {
+            // Nobody reads a claiming slot, so the key can be written without the seqlock
+            memset(&slot->reading, 0, sizeof(slot->reading));
+            strncpy(slot->reading.sensor_type_name, sensor_type_name, sizeof(slot->reading.sensor_type_name) - 1);
+            slot->reading.pin = pin;
+            atomic_store_explicit(&slot->state, SENSOR_SHM_USED, memory_order_release);
+            return sensor_shm_dedup_slot(table, slot, i, sensor_type_name, pin);
+        }
+    }
+
+    return NULL;
+}
+
+static inline int64_t sensor_shm_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Function to enter the write section by moving seq from even to odd.
+// Returns the odd value to leave with +1, or 0 if the slot stayed busy.
+static inline uint32_t sensor_shm_write_begin(struct sensor_shm_slot *slot)
+{
+    int32_t self = (int32_t)getpid();
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    for (int spin = 0; spin < SENSOR_SHM_SPINS; spin++)
+    {
+        if (!(seq & 1))
+        {
+            if (atomic_compare_exchange_weak_explicit(&slot->seq, &seq, seq + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+            {
+                atomic_store_explicit(&slot->writer, self, memory_order_relaxed);
+                return seq + 1;
+            }
+            continue; // seq was reloaded by the failed exchange
+        }
+        sched_yield();
+        seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    }
+
+    // Still odd. Only take over if the recorded writer no longer exists (killed by telegraf
+    // timeout, Ctrl+C); a live writer that is merely preempted would finish its stores after
+    // ours and tear the sample. A writer killed before storing its pid leaves 0 and the slot
+    // stays busy; readers and writers then give up on it until the table is recreated.
+    int32_t writer = atomic_load_explicit(&slot->writer, memory_order_relaxed);
+    if (!(seq & 1) || writer == 0 || writer == self || kill(writer, 0) == 0 || errno != ESRCH)
+        return 0;
+
+    // Claim the dead writer's pid first so only one of several waiting writers takes over,
+    // then move seq + 2 which keeps it odd
+    if (!atomic_compare_exchange_strong_explicit(&slot->writer, &writer, self, memory_order_relaxed,
+                                                 memory_order_relaxed))
+        return 0;
+    if (!atomic_compare_exchange_strong_explicit(&slot->seq, &seq, seq + 2, memory_order_relaxed,
+                                                 memory_order_relaxed))
+        return 0;
+    return seq + 2;
+}
+
+// Writer side of the seqlock. Returns 1 if published, 0 if the slot stayed busy.
+static inline int sensor_shm_publish(struct sensor_shm_slot *slot, int status, uint32_t fields,
+                                     float temperature, float humidity, float pressure)
+{
+    uint32_t seq = sensor_shm_write_begin(slot);
+    if (seq == 0)
+        return 0;
+    atomic_thread_fence(memory_order_release);
+
+    int64_t now = sensor_shm_now_ns();
+    slot->reading.status = status;
+    slot->reading.timestamp_ns = now;
+    if (status == SENSOR_SHM_OK)
+    {
+        // On error keep the previous values and their time so readers can tell they are stale
+        slot->reading.fields = fields;
+        slot->reading.temperature = temperature;
+        slot->reading.humidity = humidity;
+        slot->reading.pressure = pressure;
+        slot->reading.good_timestamp_ns = now;
+    }
+
+    atomic_store_explicit(&slot->writer, 0, memory_order_relaxed);
+    return atomic_compare_exchange_strong_explicit(&slot->seq, &seq, seq + 1, memory_order_release,
+                                                   memory_order_relaxed);
+}
+
+// Reader side of the seqlock. Returns 1 with a consistent copy, 0 if the slot is unused
+// or a writer kept it busy (possibly one that died mid-write).
+static inline int sensor_shm_read(struct sensor_shm_slot *slot, struct sensor_reading *out)
+{
+    if (atomic_load_explicit(&slot->state, memory_order_acquire) != SENSOR_SHM_USED)
+        return 0;
+
+    for (int spin = 0; spin < SENSOR_SHM_SPINS; spin++)
+    {
+        uint32_t seq1 = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq1 & 1)
+        {
+            sched_yield(); // writer in progress
+            continue;
+        }
+
+        memcpy(out, (const void *)&slot->reading, sizeof(*out));
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq1)
+            return 1;
+    }
+    return 0;
+}
+
+// For long running programs: map the table and find the slot once, then call sensor_shm_publish
+// on it every sample. The mapping is kept for the life of the process. Returns NULL on error.
+static inline struct sensor_shm_slot *sensor_shm_open_slot(const char *sensor_type_name, int pin)
+{
+    struct sensor_shm_table *table = sensor_shm_open(1);
+    if (table == NULL)
+        return NULL;
+
+    struct sensor_shm_slot *slot = sensor_shm_slot(table, sensor_type_name, pin);
+    if (slot == NULL)
+        sensor_shm_close(table);
+    return slot;
+}
+
+// Convenience for the sensor programs: map the table, find the slot and publish one sample
+static inline int sensor_shm_publish_once(const char *sensor_type_name, int pin, int status, uint32_t fields,
+                                          float temperature, float humidity, float pressure)
+{
+    struct sensor_shm_table *table = sensor_shm_open(1);
+    if (table == NULL)
+        return 0;
+
+    int published = 0;
+    struct sensor_shm_slot *slot = sensor_shm_slot(table, sensor_type_name, pin);
+    if (slot != NULL)
+        published = sensor_shm_publish(slot, status, fields, temperature, humidity, pressure);
+
+    sensor_shm_close(table);
+    return published;
+}
+
+#endif // SENSOR_SHM_H
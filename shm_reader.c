@@ -0,0 +1,125 @@
+// Shared-memory reader program
+// Prints the latest readings published by the sensor programs (-shm) without
+// touching the sensors. Reads are lock-free, see sensor_shm.h.
+// Sensors whose last read failed are skipped with a warning on stderr.
+// Output is in line protocol format to use in influxdata telegraf.
+// https://docs.influxdata.com/influxdb/cloud/reference/syntax/line-protocol/
+// Program for Raspberry Pi board.
+// Compiling: gcc shm_reader.c -o shm_reader -l rt
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sensor_shm.h"
+
+char hostbuffer[256];
+
+// Function to print one reading in line protocol format
+void print_reading(const struct sensor_reading *reading, int timestamps)
+{
+    char fields[128] = "";
+    size_t len = 0;
+
+    // Same precision as the sensor programs print
+    int decimals = strcmp(reading->sensor_type_name, "aht20") == 0 ? 2 : 1;
+
+    if (reading->fields & SENSOR_SHM_HUMIDITY)
+        len += snprintf(fields + len, sizeof(fields) - len, "%shumidity=%.*f", len ? "," : "", decimals, reading->humidity);
+    if (reading->fields & SENSOR_SHM_PRESSURE)
+        len += snprintf(fields + len, sizeof(fields) - len, "%spressure=%.0f", len ? "," : "", reading->pressure);
+    if (reading->fields & SENSOR_SHM_TEMPERATURE)
+        len += snprintf(fields + len, sizeof(fields) - len, "%stemperature=%.*f", len ? "," : "", decimals, reading->temperature);
+
+    if (len == 0)
+        return; // nothing good published yet
+
+    printf("Weather,host=%s", hostbuffer);
+    if (reading->pin >= 0)
+        printf(",pinnum=%d", reading->pin);
+    printf(",sensor_type_name=%s %s", reading->sensor_type_name, fields);
+    if (timestamps)
+        printf(" %lld", (long long)reading->good_timestamp_ns);
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *sensor = NULL;
+    int pin_num = -2; // -2 matches any pin, I2C sensors use -1
+    int max_age = 0;  // seconds, 0 disables the check
+    int timestamps = 0;
+
+    // Parse arguments
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-sensor") == 0 && i + 1 < argc)
+        {
+            sensor = argv[++i];
+        }
+        else if (strcmp(argv[i], "-pin") == 0 && i + 1 < argc)
+        {
+            pin_num = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-maxage") == 0 && i + 1 < argc)
+        {
+            max_age = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-timestamps") == 0)
+        {
+            timestamps = 1;
+        }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
+        {
+            printf("Usage: %s [-sensor <name>] [-pin <gpio_pin>] [-maxage <seconds>] [-timestamps]\n", argv[0]);
+            printf("  -sensor: Only print this sensor type (optional, e.g., dht22)\n");
+            printf("  -pin: Only print sensors on this GPIO pin (optional)\n");
+            printf("  -maxage: Skip readings whose last good sample is older than this many seconds (optional)\n");
+            printf("  -timestamps: Append the sample time in nanoseconds (optional)\n");
+            exit(0);
+        }
+        else
+        {
+            fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+            fprintf(stderr, "Use -h or --help for usage information\n");
+            exit(1);
+        }
+    }
+
+    struct sensor_shm_table *table = sensor_shm_open(0);
+    if (table == NULL)
+    {
+        fprintf(stderr, "Error: Cannot open shared memory %s\n", SENSOR_SHM_NAME);
+        fprintf(stderr, "Run the sensor programs with -shm first.\n");
+        exit(1);
+    }
+
+    gethostname(hostbuffer, sizeof(hostbuffer));
+    int64_t now = sensor_shm_now_ns();
+
+    for (int i = 0; i < SENSOR_SHM_SLOTS; i++)
+    {
+        struct sensor_reading reading;
+        if (!sensor_shm_read(&table->slots[i], &reading))
+            continue;
+        if (sensor != NULL && strcmp(reading.sensor_type_name, sensor) != 0)
+            continue;
+        if (pin_num != -2 && reading.pin != pin_num)
+            continue;
+        if (reading.status != SENSOR_SHM_OK)
+        {
+            // Values are from an older good sample, do not pass them off as current
+            fprintf(stderr, "Warning: last read of %s", reading.sensor_type_name);
+            if (reading.pin >= 0)
+                fprintf(stderr, " on pin %d", reading.pin);
+            fprintf(stderr, " failed, skipped\n");
+            continue;
+        }
+        if (max_age > 0 && now - reading.good_timestamp_ns > (int64_t)max_age * 1000000000LL)
+            continue;
+        print_reading(&reading, timestamps);
+    }
+
+    sensor_shm_close(table);
+    return 0;
+}